@@ -0,0 +1,388 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <numeric>
+#include <algorithm>
+#include <limits>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <json11.hpp>
+
+#include "args.hpp"
+#include "settings.hpp"
+#include "package.hpp"
+#include "site.hpp"
+#include "workspace.hpp"
+#include "job_pool.hpp"
+
+namespace {
+    struct bench_config {
+        std::vector<std::size_t> packages{1000, 10000, 100000};
+        std::size_t fanout = 4;
+        std::size_t iterations = 5;
+        std::size_t lookups = 100000;
+        std::size_t roots = 100;
+        std::size_t downloads = 64;
+        std::size_t archive_size = 1 << 20;
+        std::size_t jobs = std::thread::hardware_concurrency();
+        std::uint32_t seed = 1;
+        std::string output;
+
+        json11::Json to_json()const {
+            json11::Json::array pkgs;
+            for(auto p : packages)pkgs.emplace_back(static_cast<double>(p));
+            return json11::Json::object{
+                    {"packages", pkgs},
+                    {"fanout", static_cast<double>(fanout)},
+                    {"iterations", static_cast<double>(iterations)},
+                    {"lookups", static_cast<double>(lookups)},
+                    {"roots", static_cast<double>(roots)},
+                    {"downloads", static_cast<double>(downloads)},
+                    {"archive_size", static_cast<double>(archive_size)},
+                    {"jobs", static_cast<double>(jobs)},
+                    {"seed", static_cast<double>(seed)}
+            };
+        }
+    };
+
+    // every numeric parameter must be positive decimal integer
+    std::size_t parse_count(const std::string& key, const std::string& value, std::size_t max=std::numeric_limits<std::size_t>::max()) {
+        auto error = std::runtime_error("parameter must be positive integer. key: '" + key + "', value: '" + value + "'");
+        if(value.empty() || value.find_first_not_of("0123456789") != std::string::npos)throw error;
+
+        unsigned long long count;
+        try {
+            count = std::stoull(value);
+        }catch(const std::out_of_range&) {
+            throw error;
+        }
+        if(count == 0 || count > max)throw error;
+        return count;
+    }
+
+    // parameters are given as key=value (e.g. packages=1000,1000000 fanout=8)
+    bench_config parse_config(const std::vector<std::string>& params) {
+        bench_config config;
+        for(const auto& p : params) {
+            auto pos = p.find('=');
+            if(pos == std::string::npos) {
+                throw std::runtime_error("parameter must be key=value. parameter: '" + p + "'");
+            }
+            auto key = p.substr(0, pos), value = p.substr(pos + 1);
+
+            if(key == "packages") {
+                config.packages.clear();
+                std::stringstream ss(value);
+                std::string v;
+                while(std::getline(ss, v, ',')) {
+                    config.packages.emplace_back(parse_count(key, v));
+                }
+                if(config.packages.empty() || value.back() == ',') {
+                    throw std::runtime_error("parameter must be positive integer. key: '" + key + "', value: '" + value + "'");
+                }
+            }else if(key == "fanout") {
+                config.fanout = parse_count(key, value);
+            }else if(key == "iterations") {
+                config.iterations = parse_count(key, value);
+            }else if(key == "lookups") {
+                config.lookups = parse_count(key, value);
+            }else if(key == "roots") {
+                config.roots = parse_count(key, value);
+            }else if(key == "downloads") {
+                config.downloads = parse_count(key, value);
+            }else if(key == "archive_size") {
+                config.archive_size = parse_count(key, value);
+            }else if(key == "jobs") {
+                config.jobs = parse_count(key, value);
+            }else if(key == "seed") {
+                config.seed = static_cast<std::uint32_t>(parse_count(key, value, std::numeric_limits<std::uint32_t>::max()));
+            }else if(key == "output") {
+                config.output = value;
+            }else{
+                throw std::runtime_error("unknown parameter. key: '" + key + "'");
+            }
+        }
+        return config;
+    }
+} /* anonymous */
+
+namespace {
+    // site index of `count` packages. package i depends on up to `fanout` packages with larger index,
+    // so dependency graph is always acyclic.
+    std::string generate_index(std::size_t count, std::size_t fanout, std::uint32_t seed) {
+        std::mt19937 rng(seed);
+        json11::Json::array items;
+        items.reserve(count);
+        for(std::size_t i = 0; i < count; ++i) {
+            json11::Json::object dep;
+            if(i + 1 < count) {
+                std::uniform_int_distribution<std::size_t> dist(i + 1, count - 1);
+                for(std::size_t f = 0; f < fanout; ++f) {
+                    dep["pkg" + std::to_string(dist(rng))] = "*";
+                }
+            }
+            items.emplace_back(json11::Json::object{
+                    {"name", "pkg" + std::to_string(i)},
+                    {"version", json11::Json::object{{"name", "1.0." + std::to_string(i % 10)}, {"code", static_cast<int>(i % 10)}}},
+                    {"build", json11::Json::object{{"required", false}}},
+                    {"dependencies", dep}
+            });
+        }
+        return json11::Json(items).dump();
+    }
+
+    // result of one benchmark. times are nanoseconds.
+    // setup runs before every iteration and is not timed
+    template<class Setup, class Func> json11::Json::object measure(const std::string& name, std::size_t iterations, std::size_t items, Setup&& setup, Func&& func) {
+        std::vector<double> times;
+        times.reserve(iterations);
+        for(std::size_t i = 0; i < iterations; ++i) {
+            setup();
+            auto begin = std::chrono::steady_clock::now();
+            func();
+            auto end = std::chrono::steady_clock::now();
+            times.emplace_back(std::chrono::duration<double, std::nano>(end - begin).count());
+        }
+        std::sort(std::begin(times), std::end(times));
+        auto mean = std::accumulate(std::begin(times), std::end(times), 0.0) / times.size();
+        auto median = times[times.size() / 2];
+
+        std::cerr<<name<<": "<<median / 1e6<<" ms (median of "<<iterations<<")\n";
+        return json11::Json::object{
+                {"name", name},
+                {"iterations", static_cast<double>(iterations)},
+                {"items", static_cast<double>(items)},
+                {"min_ns", times.front()},
+                {"median_ns", median},
+                {"mean_ns", mean},
+                {"max_ns", times.back()},
+                {"items_per_sec", median > 0 ? items / (median / 1e9) : 0.0}
+        };
+    }
+
+    template<class Func> json11::Json::object measure(const std::string& name, std::size_t iterations, std::size_t items, Func&& func) {
+        return measure(name, iterations, items, [] {}, std::forward<Func>(func));
+    }
+} /* anonymous */
+
+namespace {
+    // minimal HTTP/1.0 server on loopback which answers every GET with same payload
+    class local_server {
+    private:
+        int _fd = -1;
+        std::uint16_t _port = 0;
+        std::string _payload;
+        std::atomic<bool> _stop{false};
+        std::thread _acceptor;
+
+    public:
+        explicit local_server(std::size_t size) : _payload(size, 'x') {
+            _fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            if(_fd < 0)throw std::runtime_error("socket failed.");
+
+            int yes = 1;
+            ::setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = 0;
+            socklen_t len = sizeof(addr);
+            if(::bind(_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+               || ::listen(_fd, 128) != 0
+               || ::getsockname(_fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+                ::close(_fd);
+                throw std::runtime_error("cannot start local server.");
+            }
+            _port = ntohs(addr.sin_port);
+            _acceptor = std::thread([this] {_accept();});
+        }
+        local_server(const local_server&)=delete;
+        local_server& operator=(const local_server&)=delete;
+
+        ~local_server() {
+            _stop = true;
+            ::shutdown(_fd, SHUT_RDWR);
+            _acceptor.join();
+            ::close(_fd);
+        }
+
+    private:
+        void _accept() {
+            std::vector<std::thread> connections;
+            while(!_stop) {
+                auto client = ::accept(_fd, nullptr, nullptr);
+                if(client < 0)break;
+                connections.emplace_back([this, client] {_serve(client);});
+            }
+            for(auto& c : connections)c.join();
+        }
+
+        void _serve(int client) {
+            std::string request;
+            char buf[4096];
+            while(request.find("\r\n\r\n") == std::string::npos) {
+                auto n = ::recv(client, buf, sizeof(buf), 0);
+                if(n <= 0)break;
+                request.append(buf, n);
+            }
+
+            auto response = "HTTP/1.0 200 OK\r\nContent-Length: " + std::to_string(_payload.size()) + "\r\nConnection: close\r\n\r\n";
+            response += _payload;
+            for(std::size_t sent = 0; sent < response.size();) {
+                auto n = ::send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if(n <= 0)break;
+                sent += n;
+            }
+            ::close(client);
+        }
+
+    public:
+        std::string url()const {
+            return "http://127.0.0.1:" + std::to_string(_port);
+        }
+    };
+} /* anonymous */
+
+namespace {
+    json11::Json::array bench_index(const bench_config& config, std::size_t count) {
+        json11::Json::array results;
+        auto suffix = "/" + std::to_string(count);
+
+        auto data = generate_index(count, config.fanout, config.seed);
+
+        results.emplace_back(measure("package_info::from_json_array" + suffix, config.iterations, count, [&data] {
+            auto pinfos = clpkg::package_info::from_json_array(data);
+            if(pinfos.empty())std::abort();
+        }));
+
+        // every file in sites directory is site; its package list is read from cache
+        auto url = clpkg::settings().sites_directory() + "/bench";
+        sstd::fs::remove_all(sstd::fs::path(clpkg::settings().sites_directory()));
+        clpkg::atomic_write(url, "");
+        clpkg::atomic_write(clpkg::settings().site_cache_path(url), data);
+
+        results.emplace_back(measure("site::load_package_list_from_cache" + suffix, config.iterations, count, [&url] {
+            clpkg::site s(url);
+            if(s.size() == 0)std::abort();
+        }));
+
+        clpkg::sites ss;
+        std::mt19937 rng(config.seed);
+        std::uniform_int_distribution<std::size_t> dist(0, count - 1);
+        std::vector<std::string> names(config.lookups);
+        std::generate(std::begin(names), std::end(names), [&] {return "pkg" + std::to_string(dist(rng));});
+
+        results.emplace_back(measure("sites::operator[]" + suffix, config.iterations, names.size(), [&ss, &names] {
+            for(const auto& n : names) {
+                if(ss[n].empty())std::abort();
+            }
+        }));
+
+        std::vector<std::string> roots(std::min(config.roots, count));
+        std::generate(std::begin(roots), std::end(roots), [&] {return "pkg" + std::to_string(dist(rng));});
+
+        clpkg::workspace ws(std::move(ss));
+        auto resolve = measure("workspace::resolve" + suffix, config.iterations, roots.size(), [&ws, &roots] {
+            ws.clear();
+            for(const auto& r : roots) {
+                ws.resolve(r, "*");
+            }
+        });
+        resolve["resolved_packages"] = static_cast<double>(ws.packages().size());
+        results.emplace_back(resolve);
+
+        return results;
+    }
+
+    json11::Json bench_download(const bench_config& config, clpkg::job_pool& pool) {
+        local_server server(config.archive_size);
+
+        std::vector<clpkg::package_info> pinfos;
+        for(std::size_t i = 0; i < config.downloads; ++i) {
+            pinfos.emplace_back("download" + std::to_string(i), "1.0.0", 0, false, "", std::vector<std::tuple<std::string, std::string>>{});
+            pinfos.back().origin(server.url());
+        }
+
+        // store is shared cache; remove it before every iteration so that packages are really downloaded
+        auto clear_store = [] {
+            sstd::fs::remove_all(sstd::fs::path(clpkg::settings().store_directory()));
+        };
+        auto result = measure("package_info::download", config.iterations, pinfos.size(), clear_store, [&pinfos, &pool] {
+            for(const auto& p : pinfos) {
+                pool.submit([&p] {p.download();});
+            }
+            pool.wait();
+        });
+
+        result["bytes_per_sec"] = result["items_per_sec"].number_value() * config.archive_size;
+        return result;
+    }
+} /* anonymous */
+
+namespace {
+    // HOME pointing to temporary directory. directory is removed on success and on error.
+    class temporary_home {
+    private:
+        sstd::fs::path _path;
+
+    public:
+        temporary_home() : _path(sstd::fs::temp_directory_path() / ("clpkg_bench." + std::to_string(getpid()))) {
+            sstd::fs::create_directories(_path);
+            setenv("HOME", _path.c_str(), 1);
+        }
+        temporary_home(const temporary_home&)=delete;
+        temporary_home& operator=(const temporary_home&)=delete;
+
+        ~temporary_home() {
+            std::error_code ec;
+            sstd::fs::remove_all(_path, ec);
+        }
+    };
+} /* anonymous */
+
+int main(int argc, char **argv) {
+    args::argument_parser parser("clpkg_bench: clpkg benchmark", "PROGRAM [key=value]...",
+                                 "keys: packages (comma separated), fanout, iterations, lookups, roots, downloads, archive_size, jobs, seed, output");
+    parser.parse_args(argc, argv);
+
+    try {
+        auto config = parse_config(parser.parameters());
+
+        // run against throwaway configuration directory so that real cache is never touched
+        temporary_home home;
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+
+        clpkg::job_pool pool(config.jobs);
+        json11::Json::array results;
+        for(auto count : config.packages) {
+            auto r = bench_index(config, count);
+            results.insert(std::end(results), std::begin(r), std::end(r));
+        }
+        results.emplace_back(bench_download(config, pool));
+
+        auto report = json11::Json(json11::Json::object{
+                {"config", config.to_json()},
+                {"results", results}
+        }).dump();
+
+        if(config.output.empty()) {
+            std::cout<<report<<std::endl;
+        }else{
+            clpkg::atomic_write(config.output, report + "\n");
+        }
+    }catch(const std::exception& e) {
+        std::cerr<<e.what()<<std::endl;
+        return 1;
+    }
+    return 0;
+}
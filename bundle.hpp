@@ -0,0 +1,249 @@
+#ifndef CLPKG_BUNDLE_HPP
+#define CLPKG_BUNDLE_HPP
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+#include <json11.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "settings.hpp"
+
+namespace clpkg {
+    class bundle_error : public std::runtime_error {
+        using runtime_error::runtime_error;
+    };
+
+    // bundle file layout (integers are little-endian, so bundle can be carried between hosts):
+    //   magic "CLPKGBD1" | index offset (u64) | index size (u64) | archives... | index (JSON)
+    // index is {"packages": [package info...], "archives": {"name@version": [offset, size]}}
+    namespace detail {
+        constexpr char BUNDLE_MAGIC[] = "CLPKGBD1";
+        constexpr std::size_t BUNDLE_MAGIC_SIZE = sizeof(BUNDLE_MAGIC) - 1;
+        constexpr std::size_t BUNDLE_HEADER_SIZE = BUNDLE_MAGIC_SIZE + sizeof(std::uint64_t) * 2;
+
+        inline void store_le64(char *out, std::uint64_t value) noexcept {
+            for(int i = 0; i < 8; ++i) {
+                out[i] = static_cast<char>((value >> (i * 8)) & 0xff);
+            }
+        }
+        inline std::uint64_t load_le64(const char *in) noexcept {
+            std::uint64_t value = 0;
+            for(int i = 0; i < 8; ++i) {
+                value |= std::uint64_t(static_cast<unsigned char>(in[i])) << (i * 8);
+            }
+            return value;
+        }
+    } /* detail */
+
+    constexpr char BUNDLE_EXTENSION[] = ".clpkgbundle";
+
+    // site whose url is path of bundle file is served from bundle instead of network
+    inline bool is_bundle_url(const std::string& url) {
+        constexpr std::size_t size = sizeof(BUNDLE_EXTENSION) - 1;
+        return url.size() >= size && url.compare(url.size() - size, size, BUNDLE_EXTENSION) == 0;
+    }
+
+    class bundle_writer {
+    private:
+        std::string _path, _temporary;
+        std::ofstream _out;
+        std::uint64_t _offset = detail::BUNDLE_HEADER_SIZE;
+        json11::Json::array _packages;
+        json11::Json::object _archives;
+        bool _finished = false;
+
+    public:
+        explicit bundle_writer(const std::string& path)
+                : _path(path), _temporary(path + ".tmp." + std::to_string(getpid())), _out(_temporary, std::ios::binary | std::ios::trunc) {
+            if(!_out) {
+                throw bundle_error("Cannot open bundle. path: '" + _temporary + "'");
+            }
+            std::vector<char> header(detail::BUNDLE_HEADER_SIZE, '\0');
+            _out.write(header.data(), header.size());
+        }
+        bundle_writer()=delete;
+
+        bundle_writer(const bundle_writer&)=delete;
+        bundle_writer(bundle_writer&&)=delete;
+        bundle_writer& operator=(const bundle_writer&)=delete;
+        bundle_writer& operator=(bundle_writer&&)=delete;
+
+        // bundle which was not finished (e.g. add() threw) is discarded
+        ~bundle_writer() {
+            if(!_finished) {
+                _out.close();
+                std::error_code ec;
+                sstd::fs::remove(sstd::fs::path(_temporary), ec);
+            }
+        }
+
+    public:
+        void add(const std::string& id, const json11::Json& info, const std::string& archive) {
+            std::ifstream fin(archive, std::ios::binary);
+            if(!fin) {
+                throw bundle_error("Cannot open archive. package: '" + id + "', path: '" + archive + "'");
+            }
+
+            auto begin = _offset;
+            std::vector<char> buf(1 << 16);
+            while(fin.read(buf.data(), buf.size()) || fin.gcount() > 0) {
+                _out.write(buf.data(), fin.gcount());
+                _offset += fin.gcount();
+            }
+
+            _packages.emplace_back(info);
+            _archives[id] = json11::Json::array{static_cast<double>(begin), static_cast<double>(_offset - begin)};
+        }
+
+        // archive already in memory, e.g. served from mapping of other bundle
+        void add(const std::string& id, const json11::Json& info, const char *data, std::size_t size) {
+            auto begin = _offset;
+            _out.write(data, size);
+            _offset += size;
+
+            _packages.emplace_back(info);
+            _archives[id] = json11::Json::array{static_cast<double>(begin), static_cast<double>(size)};
+        }
+
+        // write index and header, then move bundle to its final path
+        void finish() {
+            auto index = json11::Json(json11::Json::object{{"packages", _packages}, {"archives", _archives}}).dump();
+            std::uint64_t index_offset = _offset, index_size = index.size();
+            _out.write(index.data(), index.size());
+
+            char header[detail::BUNDLE_HEADER_SIZE];
+            std::memcpy(header, detail::BUNDLE_MAGIC, detail::BUNDLE_MAGIC_SIZE);
+            detail::store_le64(header + detail::BUNDLE_MAGIC_SIZE, index_offset);
+            detail::store_le64(header + detail::BUNDLE_MAGIC_SIZE + sizeof(std::uint64_t), index_size);
+
+            _out.seekp(0);
+            _out.write(header, sizeof(header));
+            _out.close();
+            if(!_out) {
+                throw bundle_error("Cannot write bundle. path: '" + _temporary + "'");
+            }
+
+            sstd::fs::rename(sstd::fs::path(_temporary), sstd::fs::path(_path));
+            _finished = true;
+        }
+    };
+
+    // read only view of bundle file. file is mapped into memory and archives are served from mapping directly.
+    class bundle {
+    private:
+        const char *_data = nullptr;
+        std::size_t _size = 0;
+        json11::Json::array _packages;
+        std::unordered_map<std::string, std::tuple<std::uint64_t /* offset */, std::uint64_t /* size */>> _archives;
+
+    public:
+        explicit bundle(const std::string& path) {
+            auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if(fd < 0) {
+                throw bundle_error("Cannot open bundle. path: '" + path + "'");
+            }
+            struct stat st{};
+            if(::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < detail::BUNDLE_HEADER_SIZE) {
+                ::close(fd);
+                throw bundle_error("Bundle is too small. path: '" + path + "'");
+            }
+            _size = st.st_size;
+            auto addr = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if(addr == MAP_FAILED) {
+                throw bundle_error("Cannot map bundle. path: '" + path + "'");
+            }
+            _data = static_cast<const char*>(addr);
+
+            try {
+                _load_index(path);
+            }catch(...) {
+                ::munmap(const_cast<char*>(_data), _size);
+                throw;
+            }
+        }
+        bundle()=delete;
+
+        bundle(const bundle&)=delete;
+        bundle(bundle&&)=delete;
+        bundle& operator=(const bundle&)=delete;
+        bundle& operator=(bundle&&)=delete;
+
+        ~bundle() {
+            ::munmap(const_cast<char*>(_data), _size);
+        }
+
+    private:
+        void _load_index(const std::string& path) {
+            if(std::memcmp(_data, detail::BUNDLE_MAGIC, detail::BUNDLE_MAGIC_SIZE) != 0) {
+                throw bundle_error("File is not clpkg bundle. path: '" + path + "'");
+            }
+            auto index_offset = detail::load_le64(_data + detail::BUNDLE_MAGIC_SIZE);
+            auto index_size = detail::load_le64(_data + detail::BUNDLE_MAGIC_SIZE + sizeof(std::uint64_t));
+            if(index_offset > _size || index_size > _size - index_offset) {
+                throw bundle_error("Bundle index is out of range. path: '" + path + "'");
+            }
+
+            std::string err;
+            auto index = json11::Json::parse(std::string(_data + index_offset, index_size), err);
+            if(!err.empty()) {
+                throw bundle_error("Bundle index is broken. path: '" + path + "', error: " + err);
+            }
+
+            _packages = index["packages"].array_items();
+            for(const auto& a : index["archives"].object_items()) {
+                auto offset = static_cast<std::uint64_t>(a.second[0].number_value());
+                auto size = static_cast<std::uint64_t>(a.second[1].number_value());
+                if(offset > index_offset || size > index_offset - offset) {
+                    throw bundle_error("Bundle archive is out of range. package: '" + a.first + "'");
+                }
+                _archives.emplace(a.first, std::make_tuple(offset, size));
+            }
+        }
+
+    public:
+        // bundles are shared by every site and package referring to same file
+        static std::shared_ptr<const bundle> open(const std::string& path) {
+            static std::mutex mutex;
+            static std::unordered_map<std::string, std::weak_ptr<const bundle>> opened;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            auto b = opened[path].lock();
+            if(!b) {
+                b = std::make_shared<const bundle>(path);
+                opened[path] = b;
+            }
+            return b;
+        }
+
+    public:
+        // site index entries of all bundled packages
+        const json11::Json::array& packages()const noexcept {
+            return _packages;
+        }
+
+        // pointer to archive inside mapping and its size
+        std::tuple<const char*, std::size_t> archive(const std::string& id)const {
+            auto itr = _archives.find(id);
+            if(itr == std::end(_archives)) {
+                throw bundle_error("Package is not bundled. package: '" + id + "'");
+            }
+            return std::make_tuple(_data + std::get<0>(itr->second), static_cast<std::size_t>(std::get<1>(itr->second)));
+        }
+    };
+} /* clpkg */
+
+#endif //CLPKG_BUNDLE_HPP
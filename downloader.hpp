@@ -13,6 +13,14 @@
 #include <curl/curl.h>
 
 namespace clpkg {
+    namespace detail {
+        inline std::size_t write_callback(char *buf, std::size_t size, std::size_t nmemb, void *userp) {
+            auto b = static_cast<std::vector<char>*>(userp);
+            b->insert(std::end(*b), buf, buf + size * nmemb);
+            return size * nmemb;
+        }
+    } /* detail */
+
     std::vector<char> downloader(const std::string& url) {
         auto curl = curl_easy_init();
         if(!curl) {
@@ -20,23 +28,17 @@ namespace clpkg {
         }
         std::vector<char> buf;
 
-        auto callback = [](void *buf, std::size_t size, std::size_t nmemb, void *userp) {
-            auto b = *static_cast<std::vector<char>*>(userp);
-            auto cb = static_cast<const char*>(buf);
-
-            b.insert(std::end(b), buf, buf + (size + nmemb));
-        };
-
         curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &detail::write_callback);
+        curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
 
         auto ret = curl_easy_perform(curl);
 
         curl_easy_cleanup(curl);
 
-        if(ret == 0) {
-            return buf;
+        if(ret != CURLE_OK) {
+            throw std::runtime_error("download failed. url: '" + url + "', error: " + curl_easy_strerror(ret));
         }
         return buf;
     }
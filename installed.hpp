@@ -0,0 +1,331 @@
+#ifndef CLPKG_INSTALLED_HPP
+#define CLPKG_INSTALLED_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ctime>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+#include <json11.hpp>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "settings.hpp"
+#include "lock.hpp"
+#include "job_pool.hpp"
+#include "sha256.hpp"
+
+namespace clpkg {
+    class installed_error : public std::runtime_error {
+        using runtime_error::runtime_error;
+    };
+
+    // size, modification time and inode of file. file whose stamp is unchanged is not hashed again.
+    // symbolic links are recorded too (e.g. libfoo.so -> libfoo.so.1); their digest covers link target.
+    struct file_stamp {
+        std::uint64_t size = 0;
+        std::int64_t mtime_sec = 0, mtime_nsec = 0;
+        std::uint64_t inode = 0;
+        bool link = false;
+
+        static bool from_path(const std::string& path, file_stamp& stamp) {
+            struct stat st{};
+            if(::lstat(path.c_str(), &st) != 0 || !(S_ISREG(st.st_mode) || S_ISLNK(st.st_mode)))return false;
+
+            stamp.link = S_ISLNK(st.st_mode);
+            stamp.size = st.st_size;
+            stamp.mtime_sec = st.st_mtim.tv_sec;
+            stamp.mtime_nsec = st.st_mtim.tv_nsec;
+            stamp.inode = st.st_ino;
+            return true;
+        }
+
+        bool operator==(const file_stamp& s)const noexcept {
+            return size == s.size && mtime_sec == s.mtime_sec && mtime_nsec == s.mtime_nsec && inode == s.inode && link == s.link;
+        }
+        bool operator!=(const file_stamp& s)const noexcept {
+            return !(*this == s);
+        }
+    };
+
+    struct verify_result {
+        std::vector<std::string> modified, missing, added;
+        std::size_t hashed = 0;
+
+        bool ok()const noexcept {
+            return modified.empty() && missing.empty() && added.empty();
+        }
+    };
+
+    // held while package is installed or its record is verified
+    inline file_lock install_lock(const std::string& name, const std::string& version) {
+        return file_lock::for_package("install", name, version);
+    }
+
+    // record of installed package: package info and digest of every installed file
+    class installed_package {
+    public:
+        static inline constexpr char RECORD_FILE[] = ".clpkg-package.json";
+
+    private:
+        struct file_entry {
+            file_stamp stamp;
+            std::string digest;
+        };
+
+        std::string _path;
+        json11::Json _info;
+        std::int64_t _recorded = 0, _scanned = 0;
+        std::map<std::string /* relative path */, file_entry> _files;
+
+        struct pending_hash {
+            std::string rel;
+            file_stamp stamp;
+            std::string digest;
+        };
+        std::vector<pending_hash> _pending;
+
+    public:
+        installed_package(const std::string& path, const json11::Json& info) : _path(path), _info(info) {}
+        installed_package()=delete;
+
+        installed_package(const installed_package&)=default;
+        installed_package(installed_package&&)=default;
+        installed_package& operator=(const installed_package&)=default;
+        installed_package& operator=(installed_package&&)=default;
+
+    private:
+        // run job on pool, or inline when called without pool (e.g. from job of pool)
+        template<class Job> static void _run(job_pool *pool, Job&& job) {
+            if(pool) {
+                pool->submit(std::forward<Job>(job));
+            }else{
+                job();
+            }
+        }
+
+        // size and inode are stored as decimal strings; JSON numbers are doubles and lose inodes above 2^53
+        static std::uint64_t _to_u64(const json11::Json& json) {
+            return std::strtoull(json.string_value().c_str(), nullptr, 10);
+        }
+
+        // digest of file content, or of link target for symbolic link
+        static std::string _digest(const std::string& file) {
+            struct stat st{};
+            if(::lstat(file.c_str(), &st) != 0 || !S_ISLNK(st.st_mode)) {
+                return sha256::file(file);
+            }
+
+            std::vector<char> target(st.st_size > 0 ? st.st_size + 1 : 4096);
+            while(true) {
+                auto n = ::readlink(file.c_str(), target.data(), target.size());
+                if(n < 0) {
+                    throw installed_error("Cannot read symbolic link. path: '" + file + "'");
+                }
+                if(static_cast<std::size_t>(n) < target.size()) {
+                    sha256 hash;
+                    hash.update("link:", 5);
+                    hash.update(target.data(), n);
+                    return hash.finish();
+                }
+                target.resize(target.size() * 2);
+            }
+        }
+
+        std::map<std::string, file_stamp> _scan()const {
+            std::map<std::string, file_stamp> files;
+            auto root = sstd::fs::path(_path);
+            for(const auto& e : sstd::fs::recursive_directory_iterator(root)) {
+                auto rel = e.path().lexically_relative(root).string();
+                if(rel == RECORD_FILE)continue;
+
+                file_stamp stamp;
+                if(file_stamp::from_path(e.path().string(), stamp)) {
+                    files.emplace(rel, stamp);
+                }
+            }
+            return files;
+        }
+
+        // stamp of file modified in same second as record was written can not tell later modification
+        bool _is_trusted(const file_stamp& stamp)const noexcept {
+            return stamp.mtime_sec < _recorded;
+        }
+
+    public:
+        const std::string& path()const noexcept {
+            return _path;
+        }
+        const json11::Json& info()const noexcept {
+            return _info;
+        }
+        std::size_t size()const noexcept {
+            return _files.size();
+        }
+
+        // same lock as install of this package takes
+        file_lock lock()const {
+            return install_lock(_info["name"].string_value(), _info["version"]["name"].string_value());
+        }
+
+    public:
+        static installed_package load(const std::string& path) {
+            std::ifstream fin(path + "/" + RECORD_FILE);
+            if(!fin) {
+                throw installed_error("Package is not installed. path: '" + path + "'");
+            }
+            std::string err;
+            auto json = json11::Json::parse(
+                    std::string(
+                            std::istreambuf_iterator<char>(fin),
+                            std::istreambuf_iterator<char>()
+                    ),
+                    err
+            );
+            if(!err.empty()) {
+                throw installed_error("Install record is broken. path: '" + path + "', error: " + err);
+            }
+
+            installed_package ip(path, json["package"]);
+            ip._recorded = static_cast<std::int64_t>(json["recorded"].number_value());
+            for(const auto& f : json["files"].object_items()) {
+                file_entry entry;
+                entry.stamp.size = _to_u64(f.second["size"]);
+                entry.stamp.mtime_sec = static_cast<std::int64_t>(f.second["mtime"][0].number_value());
+                entry.stamp.mtime_nsec = static_cast<std::int64_t>(f.second["mtime"][1].number_value());
+                entry.stamp.inode = _to_u64(f.second["inode"]);
+                entry.stamp.link = f.second["type"].string_value() == "link";
+                entry.digest = f.second["digest"].string_value();
+                ip._files.emplace(f.first, std::move(entry));
+            }
+            return ip;
+        }
+
+        // every installed package under install directory
+        static std::vector<installed_package> load_all() {
+            std::vector<installed_package> packages;
+            auto root = sstd::fs::path(settings().install_directory());
+            if(!sstd::fs::exists(root))return packages;
+
+            for(const auto& name : sstd::fs::directory_iterator(root)) {
+                if(!sstd::fs::is_directory(name.path()))continue;
+                for(const auto& version : sstd::fs::directory_iterator(name.path())) {
+                    if(sstd::fs::exists(version.path() / RECORD_FILE)) {
+                        packages.emplace_back(load(version.path().string()));
+                    }
+                }
+            }
+            return packages;
+        }
+
+        void save()const {
+            json11::Json::object files;
+            for(const auto& f : _files) {
+                const auto& s = f.second.stamp;
+                files[f.first] = json11::Json::object{
+                        {"size", std::to_string(s.size)},
+                        {"mtime", json11::Json::array{static_cast<double>(s.mtime_sec), static_cast<double>(s.mtime_nsec)}},
+                        {"inode", std::to_string(s.inode)},
+                        {"type", s.link ? "link" : "file"},
+                        {"digest", f.second.digest}
+                };
+            }
+            auto json = json11::Json(json11::Json::object{
+                    {"package", _info},
+                    {"recorded", static_cast<double>(_recorded)},
+                    {"files", files}
+            });
+            atomic_write(_path + "/" + RECORD_FILE, json.dump());
+        }
+
+        // hash every file in install directory and write record
+        void record(job_pool *pool=nullptr) {
+            // taken before scan: file modified after scan must never be trusted by its stamp
+            _recorded = std::time(nullptr);
+            auto files = _scan();
+            _files.clear();
+            for(const auto& f : files) {
+                _files[f.first].stamp = f.second;
+            }
+
+            for(auto& f : _files) {
+                auto file = _path + "/" + f.first;
+                auto& entry = f.second;
+                _run(pool, [file, &entry] {
+                    entry.digest = _digest(file);
+                });
+            }
+            if(pool)pool->wait();
+            save();
+        }
+
+        // compare installed files with record. only files whose stamp changed are hashed again.
+        // hashing is submitted to pool; pool->wait() must be called before verify_finish().
+        // so that files of many packages are hashed together, call this for every package before waiting.
+        void verify_submit(job_pool *pool, verify_result& result) {
+            _scanned = std::time(nullptr);
+            auto files = _scan();
+
+            _pending.clear();
+            for(const auto& f : _files) {
+                auto itr = files.find(f.first);
+                if(itr == std::end(files)) {
+                    result.missing.emplace_back(f.first);
+                    continue;
+                }
+                auto stamp = itr->second;
+                files.erase(itr);
+                if(stamp == f.second.stamp && _is_trusted(stamp))continue;
+
+                _pending.emplace_back(pending_hash{f.first, stamp, ""});
+            }
+            for(const auto& f : files) {
+                result.added.emplace_back(f.first);
+            }
+            result.hashed += _pending.size();
+
+            // every job writes only its own slot, and _pending is not resized until verify_finish()
+            for(auto& p : _pending) {
+                auto file = _path + "/" + p.rel;
+                _run(pool, [file, &p] {
+                    p.digest = _digest(file);
+                });
+            }
+        }
+
+        // compare rehashed digests with record. stamps of files whose content is unchanged are refreshed in record.
+        void verify_finish(verify_result& result) {
+            bool dirty = false;
+            for(const auto& p : _pending) {
+                auto& entry = _files.at(p.rel);
+                if(p.digest == entry.digest) {
+                    entry.stamp = p.stamp;
+                    dirty = true;
+                }else{
+                    result.modified.emplace_back(p.rel);
+                }
+            }
+            _pending.clear();
+
+            if(dirty) {
+                _recorded = _scanned;
+                save();
+            }
+        }
+
+        verify_result verify(job_pool *pool=nullptr) {
+            verify_result result;
+            verify_submit(pool, result);
+            if(pool)pool->wait();
+            verify_finish(result);
+            return result;
+        }
+    };
+} /* clpkg */
+
+#endif //CLPKG_INSTALLED_HPP
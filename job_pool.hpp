@@ -0,0 +1,105 @@
+#ifndef CLPKG_JOB_POOL_HPP
+#define CLPKG_JOB_POOL_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <algorithm>
+
+namespace clpkg {
+    // fixed size thread pool shared by every job of one clpkg process.
+    class job_pool {
+    private:
+        std::vector<std::thread> _workers;
+        std::deque<std::function<void()>> _jobs;
+        std::mutex _mutex;
+        std::condition_variable _job_added, _job_done;
+        std::size_t _running = 0;
+        bool _stop = false;
+        std::exception_ptr _error;
+
+    public:
+        explicit job_pool(std::size_t size=std::thread::hardware_concurrency()) {
+            size = std::max<std::size_t>(size, 1);
+            _workers.reserve(size);
+            for(std::size_t i = 0; i < size; ++i) {
+                _workers.emplace_back([this] {_worker();});
+            }
+        }
+        job_pool(const job_pool&)=delete;
+        job_pool(job_pool&&)=delete;
+        job_pool& operator=(const job_pool&)=delete;
+        job_pool& operator=(job_pool&&)=delete;
+
+        ~job_pool() {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _job_added.notify_all();
+            for(auto& w : _workers) {
+                w.join();
+            }
+        }
+
+    private:
+        void _worker() {
+            while(true) {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _job_added.wait(lock, [this] {return _stop || !_jobs.empty();});
+                    if(_jobs.empty())return;
+
+                    job = std::move(_jobs.front());
+                    _jobs.pop_front();
+                    ++_running;
+                }
+
+                std::exception_ptr error;
+                try {
+                    job();
+                }catch(...) {
+                    error = std::current_exception();
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if(error && !_error)_error = error;
+                    --_running;
+                }
+                _job_done.notify_all();
+            }
+        }
+
+    public:
+        std::size_t size()const noexcept {
+            return _workers.size();
+        }
+
+        void submit(std::function<void()> job) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _jobs.emplace_back(std::move(job));
+            }
+            _job_added.notify_one();
+        }
+
+        // wait until every submitted job finished. first exception thrown by job is rethrown here.
+        void wait() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _job_done.wait(lock, [this] {return _jobs.empty() && _running == 0;});
+            if(_error) {
+                auto error = _error;
+                _error = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+    };
+} /* clpkg */
+
+#endif //CLPKG_JOB_POOL_HPP
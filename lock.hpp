@@ -0,0 +1,121 @@
+#ifndef CLPKG_LOCK_HPP
+#define CLPKG_LOCK_HPP
+
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <atomic>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "settings.hpp"
+
+namespace clpkg {
+    class lock_error : public std::runtime_error {
+        using runtime_error::runtime_error;
+    };
+
+    // advisory inter-process lock held on a file for the lifetime of the object.
+    // every key has its own lock file, so processes working on different keys never block each other.
+    class file_lock {
+    private:
+        int _fd = -1;
+
+    public:
+        explicit file_lock(const std::string& path) {
+            _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if(_fd < 0) {
+                throw lock_error("cannot open lock file. path: '" + path + "'");
+            }
+            while(::flock(_fd, LOCK_EX) != 0) {
+                if(errno != EINTR) {
+                    ::close(_fd);
+                    throw lock_error("cannot acquire lock. path: '" + path + "'");
+                }
+            }
+        }
+        file_lock()=delete;
+
+        file_lock(const file_lock&)=delete;
+        file_lock(file_lock&& fl) noexcept : _fd(fl._fd) {
+            fl._fd = -1;
+        }
+        file_lock& operator=(const file_lock&)=delete;
+        file_lock& operator=(file_lock&& fl) noexcept {
+            std::swap(_fd, fl._fd);
+            return *this;
+        }
+
+        ~file_lock() {
+            if(_fd >= 0) {
+                ::flock(_fd, LOCK_UN);
+                ::close(_fd);
+            }
+        }
+
+    public:
+        // lock identified by key (e.g. package name and version, cache url)
+        static file_lock for_key(std::string key) {
+            std::replace(std::begin(key), std::end(key), '/', '@');
+            sstd::fs::create_directories(sstd::fs::path(settings().lock_directory()));
+            return file_lock(settings().lock_directory() + "/" + key + ".lock");
+        }
+
+        // lock of one package. name and version are separate path components, so they can never collide
+        // (e.g. 'foo-bar'@'1.0' and 'foo'@'bar-1.0')
+        static file_lock for_package(const std::string& kind, const std::string& name, const std::string& version) {
+            auto dir = settings().lock_directory() + "/" + kind + "/" + name;
+            sstd::fs::create_directories(sstd::fs::path(dir));
+            return file_lock(dir + "/" + version + ".lock");
+        }
+    };
+
+    // write data to temporary file next to path, fsync it and rename it over path.
+    // readers always see either old or new file, never partially written one,
+    // and after crash renamed file is never left empty.
+    inline void atomic_write(const std::string& path, const char *data, std::size_t size) {
+        sstd::fs::path target(path);
+        if(target.has_parent_path()) {
+            sstd::fs::create_directories(target.parent_path());
+        }
+
+        static std::atomic<unsigned> sequence{0};
+        auto temporary = path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(sequence++);
+
+        auto fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(fd < 0) {
+            throw std::runtime_error("cannot open file. path: '" + temporary + "'");
+        }
+        for(std::size_t written = 0; written < size;) {
+            auto n = ::write(fd, data + written, size - written);
+            if(n < 0 && errno == EINTR)continue;
+            if(n <= 0) {
+                ::close(fd);
+                sstd::fs::remove(sstd::fs::path(temporary));
+                throw std::runtime_error("cannot write file. path: '" + temporary + "'");
+            }
+            written += n;
+        }
+        if(::fsync(fd) != 0 || ::close(fd) != 0) {
+            sstd::fs::remove(sstd::fs::path(temporary));
+            throw std::runtime_error("cannot write file. path: '" + temporary + "'");
+        }
+        sstd::fs::rename(sstd::fs::path(temporary), target);
+
+        // make rename itself durable
+        auto dir = ::open(target.has_parent_path() ? target.parent_path().c_str() : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if(dir >= 0) {
+            ::fsync(dir);
+            ::close(dir);
+        }
+    }
+
+    inline void atomic_write(const std::string& path, const std::string& data) {
+        atomic_write(path, data.data(), data.size());
+    }
+} /* clpkg */
+
+#endif //CLPKG_LOCK_HPP
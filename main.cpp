@@ -1,8 +1,10 @@
 #include <iostream>
+#include <csignal>
 
 #include "package.hpp"
 #include "args.hpp"
 #include "settings.hpp"
+#include "workspace.hpp"
 
 namespace {
     constexpr char VERSION[] = "0.0.1";
@@ -13,14 +15,165 @@ namespace {
 } /* anonymous */
 
 namespace {
-    int installer(const args::argument_parser& ins) {return 0;}
+    int installer(const args::argument_parser& ins) {
+        auto manifests = ins.parameters();
+        if(manifests.empty()) {
+            manifests.emplace_back("clpkg.json");
+        }
+
+        try {
+            clpkg::job_pool pool;
+            clpkg::workspace ws;
+            if(ins.exists("--update")) {
+                ws.package_sites().update(pool);
+            }
+            for(const auto& m : manifests) {
+                ws.add_manifest(m);
+            }
+
+            ws.install(pool);
+            std::cout<<"installed "<<ws.packages().size()<<" packages for "<<ws.manifests().size()<<" manifests\n";
+        }catch(const std::exception& e) {
+            std::cerr<<e.what()<<std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    int bundler(const args::argument_parser& bun) {
+        const auto& params = bun.parameters();
+        if(params.empty()) {
+            std::cerr<<"bundle file is not specified"<<std::endl;
+            return 1;
+        }
+        auto output = params[0];
+        if(!clpkg::is_bundle_url(output)) {
+            output += clpkg::BUNDLE_EXTENSION;
+        }
+        std::vector<std::string> manifests(std::begin(params) + 1, std::end(params));
+        if(manifests.empty()) {
+            manifests.emplace_back("clpkg.json");
+        }
+
+        try {
+            clpkg::job_pool pool;
+            clpkg::workspace ws;
+            if(bun.exists("--update")) {
+                ws.package_sites().update(pool);
+            }
+            for(const auto& m : manifests) {
+                ws.add_manifest(m);
+            }
+
+            auto archives = ws.download(pool, false);
+            clpkg::bundle_writer writer(output);
+            for(const auto& p : ws.packages()) {
+                if(const auto& source = p.source_bundle()) {
+                    // package of bundle site has no downloaded archive; copy it from source bundle
+                    const char *data;
+                    std::size_t size;
+                    std::tie(data, size) = source->archive(p.id());
+                    writer.add(p.id(), p.to_json(), data, size);
+                }else{
+                    writer.add(p.id(), p.to_json(), archives.at(p.id()));
+                }
+            }
+            writer.finish();
+            std::cout<<"bundled "<<ws.packages().size()<<" packages into "<<output<<'\n';
+        }catch(const std::exception& e) {
+            std::cerr<<e.what()<<std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    int verifier(const args::argument_parser& ver) {
+        const auto& names = ver.parameters();
+        std::size_t files = 0, hashed = 0, broken = 0;
+
+        try {
+            auto id_of = [](const clpkg::installed_package& ip) {
+                return ip.info()["name"].string_value() + "@" + ip.info()["version"]["name"].string_value();
+            };
+
+            std::vector<clpkg::installed_package> packages;
+            std::vector<bool> matched(names.size(), false);
+            for(auto& ip : clpkg::installed_package::load_all()) {
+                if(!names.empty()) {
+                    auto name = ip.info()["name"].string_value();
+                    auto id = id_of(ip);
+                    bool selected = false;
+                    for(std::size_t i = 0; i < names.size(); ++i) {
+                        if(names[i] == name || names[i] == id) {
+                            matched[i] = true;
+                            selected = true;
+                        }
+                    }
+                    if(!selected)continue;
+                }
+                packages.emplace_back(std::move(ip));
+            }
+
+            bool unknown = false;
+            for(std::size_t i = 0; i < names.size(); ++i) {
+                if(!matched[i]) {
+                    std::cerr<<"package is not installed: "<<names[i]<<std::endl;
+                    unknown = true;
+                }
+            }
+            if(unknown)return 1;
+
+            // lock in fixed order so that concurrent verifiers never wait on each other in a cycle
+            std::sort(std::begin(packages), std::end(packages), [](const clpkg::installed_package& lhs, const clpkg::installed_package& rhs) {
+                return lhs.path() < rhs.path();
+            });
+            std::vector<clpkg::file_lock> locks;
+            locks.reserve(packages.size());
+            for(auto& ip : packages) {
+                locks.emplace_back(ip.lock());
+                // record may have been rewritten by install or other verify before lock was taken
+                ip = clpkg::installed_package::load(ip.path());
+            }
+
+            // hash changed files of every package on pool at once, then wait only once
+            clpkg::job_pool pool;
+            std::vector<clpkg::verify_result> results(packages.size());
+            for(std::size_t i = 0; i < packages.size(); ++i) {
+                packages[i].verify_submit(&pool, results[i]);
+            }
+            pool.wait();
+
+            for(std::size_t i = 0; i < packages.size(); ++i) {
+                auto& ip = packages[i];
+                auto& result = results[i];
+                ip.verify_finish(result);
+                files += ip.size();
+                hashed += result.hashed;
+                if(result.ok())continue;
+
+                ++broken;
+                auto id = id_of(ip);
+                for(const auto& f : result.modified)std::cout<<id<<": modified "<<f<<'\n';
+                for(const auto& f : result.missing)std::cout<<id<<": missing "<<f<<'\n';
+                for(const auto& f : result.added)std::cout<<id<<": added "<<f<<'\n';
+            }
+        }catch(const std::exception& e) {
+            std::cerr<<e.what()<<std::endl;
+            return 1;
+        }
+
+        std::cout<<"verified "<<files<<" files ("<<hashed<<" hashed), "<<broken<<" packages changed\n";
+        return broken == 0 ? 0 : 2;
+    }
     int uninstaller(const args::argument_parser& uin) {return 0;}
 } /* anonymous */
 
 int main(int argc, char **argv) {
     args::argument_parser parser("clpkg: C/C++ Libraries Package manager", "PROGRAM [flags]... [positional]...", "Released under the Apache License 2.0");
     parser.add_flag({"--version"}, "show version");
-    auto install = parser.add_subcommand("install", "install library");
+    auto install = parser.add_subcommand("install", "install libraries required by manifests (default: clpkg.json)");
+    install.add_flag({"--update"}, "download package lists of sites before install");
+    auto bundle = parser.add_subcommand("bundle", "pack libraries required by manifests into bundle file for offline install (BUNDLE [manifests]...)");
+    bundle.add_flag({"--update"}, "download package lists of sites before bundle");
+    auto verify = parser.add_subcommand("verify", "verify installed files of libraries (all libraries when no name is given)");
     auto uninstall = parser.add_subcommand("uninstall", "uninstall library");
 
     parser.parse_args(argc, argv);
@@ -31,10 +184,20 @@ int main(int argc, char **argv) {
     }
 
     sstd::fs::create_directory(sstd::fs::path(clpkg::settings().temporary_directory()));
+    // downloads run on several threads; curl must be initialized before any of them starts
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    // writing to pipe of tar which exited early must fail with EPIPE, not kill process
+    std::signal(SIGPIPE, SIG_IGN);
 
     if(install.is_selected()) {
         return installer(install);
     }
+    if(bundle.is_selected()) {
+        return bundler(bundle);
+    }
+    if(verify.is_selected()) {
+        return verifier(verify);
+    }
     if(uninstall.is_selected()) {
         return uninstaller(uninstall);
     }
@@ -7,14 +7,20 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 
 #include <json11.hpp>
 #include <algorithm>
+#include <cstdlib>
+#include <cstdio>
 #include "settings.hpp"
 #include "downloader.hpp"
+#include "lock.hpp"
+#include "bundle.hpp"
+#include "installed.hpp"
 
 namespace clpkg {
-    class package_error : std::runtime_error {
+    class package_error : public std::runtime_error {
         using runtime_error::runtime_error;
     };
 
@@ -25,6 +31,8 @@ namespace clpkg {
         bool _is_build_required;
         std::string _build_command;
         std::vector<std::tuple<std::string /* name */, std::string /* version */>> _dependencies;
+        std::string _origin;
+        std::shared_ptr<const bundle> _bundle;
 
     public:
         package_info() {}
@@ -34,6 +42,19 @@ namespace clpkg {
                 : _name(name), _version(version), _code(code), _is_build_required(is_build_required), _build_command(command), _dependencies(dep){
         }
 
+    private:
+        // name and version become directory names and parts of shell command lines
+        static bool _is_safe_component(const std::string& s) {
+            return !s.empty() && s != "." && s != ".." && s.find_first_of("/'") == std::string::npos;
+        }
+
+        void _check_safe()const {
+            if(!_is_safe_component(_name) || !_is_safe_component(_version)) {
+                throw package_error("Package name or version is not valid. name: '" + _name + "', version: '" + _version + "'");
+            }
+        }
+
+    public:
         static package_info from_json(const json11::Json& json) {
             const auto& items = json.object_items();
             if(items.count("name") == 0) {
@@ -65,7 +86,9 @@ namespace clpkg {
                 }
             }
 
-            return package_info(json["name"].string_value(), json["version"]["name"].string_value(), json["version"]["code"].int_value(), is_build_required, command, dep);
+            package_info info(json["name"].string_value(), json["version"]["name"].string_value(), json["version"]["code"].int_value(), is_build_required, command, dep);
+            info._check_safe();
+            return info;
         }
 
         static package_info from_json(const std::string& json_str) {
@@ -108,10 +131,114 @@ namespace clpkg {
         const std::string& build_command() const noexcept {
             return _build_command;
         }
+        const std::vector<std::tuple<std::string, std::string>>& dependencies()const noexcept {
+            return _dependencies;
+        }
+
+        json11::Json to_json()const {
+            json11::Json::object dep;
+            for(const auto& d : _dependencies) {
+                dep[std::get<0>(d)] = std::get<1>(d);
+            }
+            return json11::Json::object{
+                    {"name", _name},
+                    {"version", json11::Json::object{{"name", _version}, {"code", _code}}},
+                    {"build", json11::Json::object{{"required", _is_build_required}, {"command", _build_command}}},
+                    {"dependencies", dep}
+            };
+        }
+
+        // url of site which provides this package
+        const std::string& origin()const noexcept {
+            return _origin;
+        }
+        void origin(const std::string& url, std::shared_ptr<const bundle> b=nullptr) {
+            _origin = url;
+            _bundle = std::move(b);
+        }
+        // bundle serving this package, or null when package is downloaded from network
+        const std::shared_ptr<const bundle>& source_bundle()const noexcept {
+            return _bundle;
+        }
+
+        std::string id()const {
+            return name() + "@" + version();
+        }
+
+        std::string archive_path()const {
+            return settings().store_directory() + "/" + name() + "/" + version();
+        }
+
+        // download archive into shared store and return its path.
+        // concurrent processes wait on per-package lock and reuse archive downloaded by first one.
+        // packages from bundle are not downloaded and empty path is returned.
+        std::string download()const {
+            if(_bundle)return "";
+            _check_safe();
+
+            auto file_name = archive_path();
+            auto lock = file_lock::for_package("package", name(), version());
+            // empty entry can only be left by crash of older clpkg; download it again
+            std::error_code ec;
+            auto stored = sstd::fs::file_size(sstd::fs::path(file_name), ec);
+            if(!ec && stored > 0) {
+                return file_name;
+            }
+
+            auto data = downloader(origin() + "/packages/" + name() + "/" + version());
+            atomic_write(file_name, data.data(), data.size());
+            return file_name;
+        }
+
+    private:
+        bool _extract(const std::string& archive, const std::string& dir)const {
+            if(!_bundle) {
+                return std::system(("tar xf '" + archive + "' -C '" + dir + "'").c_str()) == 0;
+            }
+
+            // stream archive from mapped bundle into tar without writing it to disk
+            const char *data;
+            std::size_t size;
+            std::tie(data, size) = _bundle->archive(id());
+
+            // SIGPIPE is ignored by main, so tar exiting early shows up as short write (EPIPE) instead of killing us
+            auto tar = popen(("tar xf - -C '" + dir + "'").c_str(), "w");
+            if(!tar)return false;
+            auto written = std::fwrite(data, 1, size, tar);
+            auto write_failed = written != size || std::fflush(tar) != 0 || std::ferror(tar);
+            return pclose(tar) == 0 && !write_failed;
+        }
+
+    public:
+        std::string install_path()const {
+            return settings().install_directory() + "/" + name() + "/" + version();
+        }
+        bool is_installed()const {
+            return sstd::fs::exists(sstd::fs::path(install_path() + "/" + installed_package::RECORD_FILE));
+        }
+
+        // extract archive into install directory and run build command.
+        // install is skipped when other process (or earlier project of workspace) already installed this package.
+        void install(const std::string& archive)const {
+            _check_safe();
+            auto lock = install_lock(name(), version());
+            if(is_installed())return;
+
+            auto dir = install_path();
+            sstd::fs::remove_all(sstd::fs::path(dir));
+            sstd::fs::create_directories(sstd::fs::path(dir));
+
+            if(!_extract(archive, dir)) {
+                sstd::fs::remove_all(sstd::fs::path(dir));
+                throw package_error("Cannot extract package. name: '" + name() + "'");
+            }
+            if(is_build_required() && !build_command().empty()) {
+                if(std::system(("cd '" + dir + "' && " + build_command()).c_str()) != 0) {
+                    throw package_error("Build command failed. name: '" + name() + "'");
+                }
+            }
 
-        void download(const std::string& dir)const {
-            auto file_name = settings().temporary_directory() + "/" + name() + version();
-            downloader()
+            installed_package(dir, to_json()).record();
         }
     };
 
@@ -45,6 +45,20 @@ namespace clpkg {
         std::string cache()const {
             return _config + "/.cache";
         }
+        // cached package list of site
+        std::string site_cache_path(std::string url)const {
+            std::replace(std::begin(url), std::end(url), '/', '@');
+            return cache() + "/sites/" + url + ".json";
+        }
+        std::string store_directory()const {
+            return cache() + "/packages";
+        }
+        std::string lock_directory()const {
+            return cache() + "/locks";
+        }
+        std::string install_directory()const {
+            return _config + "/packages";
+        }
         std::string sites_directory()const {
             return _config + "/sites";
         }
@@ -53,7 +67,7 @@ namespace clpkg {
         }
 
         std::vector<std::string> package_sites()const {
-            sstd::fs::directory_iterator ditr(sstd::fs::path(sites_directory()));
+            sstd::fs::directory_iterator ditr{sstd::fs::path(sites_directory())};
             std::vector<sstd::fs::path> paths(sstd::fs::begin(ditr), sstd::fs::end(ditr));
 
             std::vector<std::string> dirs(paths.size());
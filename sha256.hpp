@@ -0,0 +1,132 @@
+#ifndef CLPKG_SHA256_HPP
+#define CLPKG_SHA256_HPP
+
+#include <string>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace clpkg {
+    class sha256 {
+    private:
+        std::array<std::uint32_t, 8> _state{{
+                0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        }};
+        std::array<unsigned char, 64> _block{};
+        std::size_t _block_size = 0;
+        std::uint64_t _length = 0;
+
+    private:
+        static std::uint32_t _rotr(std::uint32_t x, int n) noexcept {
+            return (x >> n) | (x << (32 - n));
+        }
+
+        void _transform(const unsigned char *data) noexcept {
+            static constexpr std::uint32_t K[64] = {
+                    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+            };
+
+            std::uint32_t w[64];
+            for(int i = 0; i < 16; ++i) {
+                w[i] = (std::uint32_t(data[i * 4]) << 24) | (std::uint32_t(data[i * 4 + 1]) << 16) |
+                       (std::uint32_t(data[i * 4 + 2]) << 8) | std::uint32_t(data[i * 4 + 3]);
+            }
+            for(int i = 16; i < 64; ++i) {
+                auto s0 = _rotr(w[i - 15], 7) ^ _rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                auto s1 = _rotr(w[i - 2], 17) ^ _rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            auto a = _state[0], b = _state[1], c = _state[2], d = _state[3];
+            auto e = _state[4], f = _state[5], g = _state[6], h = _state[7];
+            for(int i = 0; i < 64; ++i) {
+                auto t1 = h + (_rotr(e, 6) ^ _rotr(e, 11) ^ _rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+                auto t2 = (_rotr(a, 2) ^ _rotr(a, 13) ^ _rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g; g = f; f = e; e = d + t1;
+                d = c; c = b; b = a; a = t1 + t2;
+            }
+            _state[0] += a; _state[1] += b; _state[2] += c; _state[3] += d;
+            _state[4] += e; _state[5] += f; _state[6] += g; _state[7] += h;
+        }
+
+    public:
+        void update(const void *data, std::size_t size) noexcept {
+            auto p = static_cast<const unsigned char*>(data);
+            _length += size;
+
+            if(_block_size != 0) {
+                auto n = std::min(size, _block.size() - _block_size);
+                std::memcpy(_block.data() + _block_size, p, n);
+                _block_size += n;
+                p += n;
+                size -= n;
+                if(_block_size < _block.size())return;
+                _transform(_block.data());
+                _block_size = 0;
+            }
+            for(; size >= _block.size(); p += _block.size(), size -= _block.size()) {
+                _transform(p);
+            }
+            std::memcpy(_block.data(), p, size);
+            _block_size = size;
+        }
+
+        // hex encoded digest. object must not be updated after this call.
+        std::string finish() {
+            auto bits = _length * 8;
+            unsigned char pad[72] = {0x80};
+            auto pad_size = (_block_size < 56 ? 56 : 120) - _block_size;
+            for(int i = 0; i < 8; ++i) {
+                pad[pad_size + i] = static_cast<unsigned char>(bits >> (56 - i * 8));
+            }
+            update(pad, pad_size + 8);
+
+            constexpr char HEX[] = "0123456789abcdef";
+            std::string digest;
+            digest.reserve(64);
+            for(auto s : _state) {
+                for(int i = 28; i >= 0; i -= 4) {
+                    digest += HEX[(s >> i) & 0xf];
+                }
+            }
+            return digest;
+        }
+
+    public:
+        static std::string file(const std::string& path) {
+            auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if(fd < 0) {
+                throw std::runtime_error("Cannot open file. path: '" + path + "'");
+            }
+
+            sha256 hash;
+            unsigned char buf[1 << 16];
+            ssize_t n;
+            while((n = ::read(fd, buf, sizeof(buf))) != 0) {
+                if(n < 0) {
+                    if(errno == EINTR)continue;
+                    ::close(fd);
+                    throw std::runtime_error("Cannot read file. path: '" + path + "'");
+                }
+                hash.update(buf, n);
+            }
+            ::close(fd);
+            return hash.finish();
+        }
+    };
+} /* clpkg */
+
+#endif //CLPKG_SHA256_HPP
@@ -8,6 +8,7 @@
 #include <fstream>
 #include <unordered_map>
 #include <algorithm>
+#include <numeric>
 
 #if __has_include(<optional>)
 #   include <optional>
@@ -26,15 +27,21 @@ namespace sstd {
 #include "package.hpp"
 #include "downloader.hpp"
 #include "settings.hpp"
+#include "lock.hpp"
+#include "job_pool.hpp"
+#include "bundle.hpp"
 
 namespace clpkg {
     class site {
     private:
         std::string _url;
         std::unordered_map<std::string, std::vector<package_info>> _packages;
+        std::shared_ptr<const bundle> _bundle;
 
     public:
         explicit site(const std::string& url) : _url(url) {
+            // bundle stays mapped while site or any of its packages is alive
+            if(is_bundle_url(_url))_bundle = bundle::open(_url);
             load_package_list_from_cache();
         }
         site()=delete;
@@ -46,29 +53,53 @@ namespace clpkg {
 
     private:
         std::string _cache_path() {
-            std::string url = _url;
-            std::replace(std::begin(url), std::end(url), '/', '@');
-            return settings().cache() + "/sites/" + url + ".json";
+            return settings().site_cache_path(_url);
         }
 
         void _load_impl(const std::vector<package_info>& pi, bool clear_cache=true) {
             if(clear_cache)_packages.clear();
             for(const auto& p : pi) {
-                _packages[p.name()].emplace_back(p);
+                auto& pkg = _packages[p.name()];
+                pkg.emplace_back(p);
+                pkg.back().origin(_url, _bundle);
             }
         }
 
     public:
         void download_package_list() {
+            if(_bundle) {
+                load_package_list_from_cache();
+                return;
+            }
+
+            auto requested = sstd::fs::file_time_type::clock::now();
+            auto lock = file_lock::for_key("site-" + _url);
+
+            // another process refreshed list while we were waiting for lock
+            std::error_code ec;
+            auto modified = sstd::fs::last_write_time(sstd::fs::path(_cache_path()), ec);
+            if(!ec && modified >= requested && load_package_list_from_cache()) {
+                return;
+            }
+
             auto data = to_string(downloader(_url + "/packages"));
             auto packages = package_info::from_json_array(data);
             _load_impl(packages);
 
-            std::ofstream fout(_cache_path());
-            fout<<data<<std::endl;
+            atomic_write(_cache_path(), data + "\n");
         }
 
         bool load_package_list_from_cache() {
+            if(_bundle) {
+                const auto& items = _bundle->packages();
+                std::vector<package_info> packages(items.size());
+                std::transform(std::begin(items), std::end(items), std::begin(packages), [](const json11::Json& j) {
+                    return package_info::from_json(j);
+                });
+                _load_impl(packages);
+                return true;
+            }
+
             std::ifstream fin(_cache_path());
             if(!fin)return false;
 
@@ -84,22 +115,29 @@ namespace clpkg {
 
     public:
         const std::vector<package_info>& operator[](const std::string& name)const {
-            if(_packages.count(name) == 0)return {};
-            return _packages.at(name);
+            static const std::vector<package_info> empty;
+            auto itr = _packages.find(name);
+            if(itr == std::end(_packages))return empty;
+            return itr->second;
         }
 
         std::size_t size()const {
-            return std::accumulate(std::begin(_packages), std::end(_packages), 0ul, [](const std::vector<package_info>& lhs, const std::vector<package_info>& rhs) {
-                return lhs.size() + rhs.size();
+            return std::accumulate(std::begin(_packages), std::end(_packages), 0ul, [](std::size_t lhs, const auto& rhs) {
+                return lhs + rhs.second.size();
             });
         }
+
+        const std::string& url()const noexcept {
+            return _url;
+        }
     };
 
     namespace detail {
         inline std::vector<site> to_sites(const std::vector<std::string>& s) {
-            std::vector<site> ss(s.size());
+            std::vector<site> ss;
+            ss.reserve(s.size());
 
-            std::transform(std::begin(s), std::end(s), std::begin(ss), [](const std::string& s) {return site(s);});
+            std::transform(std::begin(s), std::end(s), std::back_inserter(ss), [](const std::string& s) {return site(s);});
             return ss;
         }
     } /* detail */
@@ -118,8 +156,8 @@ namespace clpkg {
 
     public:
         std::vector<package_info> operator[](const std::string& name)const {
-            auto size = std::accumulate(std::begin(_sites), std::end(_sites), 0ul, [](const site& lhs, const site& rhs) {
-                return lhs.size() + rhs.size();
+            auto size = std::accumulate(std::begin(_sites), std::end(_sites), 0ul, [&name](std::size_t lhs, const site& rhs) {
+                return lhs + rhs[name].size();
             });
             std::vector<package_info> pinfos;
             pinfos.reserve(size);
@@ -132,6 +170,14 @@ namespace clpkg {
             pinfos.erase(std::unique(std::begin(pinfos), std::end(pinfos)), std::end(pinfos));
             return pinfos;
         }
+
+        // refresh package lists of every site. each site is downloaded by job of pool.
+        void update(job_pool& pool) {
+            for(auto& s : _sites) {
+                pool.submit([&s] {s.download_package_list();});
+            }
+            pool.wait();
+        }
     };
 } /* clpkg */
 
@@ -0,0 +1,198 @@
+#ifndef CLPKG_WORKSPACE_HPP
+#define CLPKG_WORKSPACE_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <fstream>
+#include <stdexcept>
+
+#include <json11.hpp>
+
+#include "package.hpp"
+#include "site.hpp"
+#include "job_pool.hpp"
+
+namespace clpkg {
+    class workspace_error : public std::runtime_error {
+        using runtime_error::runtime_error;
+    };
+
+    // set of projects (manifests) resolved against one sites index and installed together.
+    // package required by several projects is downloaded and built only once.
+    class workspace {
+    private:
+        sites _sites;
+        std::vector<std::string> _manifests;
+        std::unordered_map<std::string /* name@constraint */, package_info> _solved;
+        std::map<std::string /* name@version */, package_info> _packages;
+
+    public:
+        workspace()=default;
+        explicit workspace(sites s) : _sites(std::move(s)) {}
+
+        workspace(const workspace&)=default;
+        workspace(workspace&&)=default;
+        workspace& operator=(const workspace&)=default;
+        workspace& operator=(workspace&&)=default;
+
+    private:
+        static bool _satisfies(const package_info& p, const std::string& constraint) {
+            return constraint.empty() || constraint == "*" || p.version() == constraint;
+        }
+
+        std::size_t _level(const package_info& p, std::unordered_map<std::string, std::size_t>& levels, std::vector<std::string>& visiting)const {
+            auto id = p.id();
+            auto itr = levels.find(id);
+            if(itr != std::end(levels))return itr->second;
+            if(std::find(std::begin(visiting), std::end(visiting), id) != std::end(visiting)) {
+                throw workspace_error("Circular dependency detected. package: '" + id + "'");
+            }
+
+            visiting.emplace_back(id);
+            std::size_t level = 0;
+            for(const auto& d : p.dependencies()) {
+                const auto& dep = _solved.at(std::get<0>(d) + "@" + std::get<1>(d));
+                level = std::max(level, _level(dep, levels, visiting) + 1);
+            }
+            visiting.pop_back();
+
+            levels[id] = level;
+            return level;
+        }
+
+    public:
+        sites& package_sites()noexcept {
+            return _sites;
+        }
+
+        // resolve dependency with solver cache shared by every manifest of workspace
+        const package_info& resolve(const std::string& name, const std::string& constraint) {
+            auto key = name + "@" + constraint;
+            auto itr = _solved.find(key);
+            if(itr != std::end(_solved))return itr->second;
+
+            auto candidates = _sites[name];
+            auto best = std::end(candidates);
+            for(auto c = std::begin(candidates); c != std::end(candidates); ++c) {
+                if(!_satisfies(*c, constraint))continue;
+                if(best == std::end(candidates) || best->version_code() < c->version_code()) {
+                    best = c;
+                }
+            }
+            if(best == std::end(candidates)) {
+                throw workspace_error("No package satisfies dependency. name: '" + name + "', version: '" + constraint + "'");
+            }
+
+            const auto& p = _solved.emplace(key, *best).first->second;
+            _packages.emplace(p.id(), p);
+            for(const auto& d : p.dependencies()) {
+                resolve(std::get<0>(d), std::get<1>(d));
+            }
+            return p;
+        }
+
+        // forget resolved packages and manifests. sites index is kept.
+        void clear() {
+            _manifests.clear();
+            _solved.clear();
+            _packages.clear();
+        }
+
+        void add_manifest(const std::string& path) {
+            std::ifstream fin(path);
+            if(!fin) {
+                throw workspace_error("Cannot open manifest. path: '" + path + "'");
+            }
+
+            std::string err;
+            auto json = json11::Json::parse(
+                    std::string(
+                            std::istreambuf_iterator<char>(fin),
+                            std::istreambuf_iterator<char>()
+                    ),
+                    err
+            );
+            if(!err.empty()) {
+                throw workspace_error("Manifest is not valid JSON. path: '" + path + "', error: " + err);
+            }
+
+            for(const auto& d : json["dependencies"].object_items()) {
+                if(!d.second.is_string()) {
+                    throw workspace_error("Manifest dependency is not valid type. path: '" + path + "'");
+                }
+                resolve(d.first, d.second.string_value());
+            }
+            _manifests.emplace_back(path);
+        }
+
+    public:
+        const std::vector<std::string>& manifests()const noexcept {
+            return _manifests;
+        }
+
+        // unique packages required by all manifests
+        std::vector<package_info> packages()const {
+            std::vector<package_info> pinfos;
+            pinfos.reserve(_packages.size());
+            for(const auto& p : _packages) {
+                pinfos.emplace_back(p.second);
+            }
+            return pinfos;
+        }
+
+        // packages grouped so that every dependency of package is in earlier group
+        std::vector<std::vector<package_info>> install_order()const {
+            std::unordered_map<std::string, std::size_t> levels;
+            std::vector<std::string> visiting;
+            std::vector<std::vector<package_info>> order;
+            for(const auto& p : _packages) {
+                auto level = _level(p.second, levels, visiting);
+                if(order.size() <= level)order.resize(level + 1);
+                order[level].emplace_back(p.second);
+            }
+            return order;
+        }
+
+        // download every unique package in parallel and return archive path of each package (name@version)
+        std::unordered_map<std::string, std::string> download(job_pool& pool, bool skip_installed=true)const {
+            std::mutex mutex;
+            std::unordered_map<std::string, std::string> archives;
+            for(const auto& p : _packages) {
+                const auto& pkg = p.second;
+                pool.submit([&pkg, &mutex, &archives, skip_installed] {
+                    if(skip_installed && pkg.is_installed())return;
+
+                    auto archive = pkg.download();
+                    std::lock_guard<std::mutex> lock(mutex);
+                    archives[pkg.id()] = archive;
+                });
+            }
+            pool.wait();
+            return archives;
+        }
+
+        // download every unique package, then install them level by level on same pool
+        void install(job_pool& pool)const {
+            auto order = install_order();
+            auto archives = download(pool);
+
+            for(const auto& level : order) {
+                for(const auto& pkg : level) {
+                    auto itr = archives.find(pkg.id());
+                    if(itr == std::end(archives))continue;
+
+                    const auto& archive = itr->second;
+                    pool.submit([&pkg, &archive] {
+                        pkg.install(archive);
+                    });
+                }
+                pool.wait();
+            }
+        }
+    };
+} /* clpkg */
+
+#endif //CLPKG_WORKSPACE_HPP